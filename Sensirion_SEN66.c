@@ -74,6 +74,11 @@ uint8_t const addr_read_measured_values[] = { 0x03, 0x00 };
  * BEGIN PRIVATE VARIABLES FOR READ-WRITE FUNCTIONS
  ****/
 uint8_t const addr_read_and_clear_device_status[] = { 0xD2, 0x10 };
+
+uint8_t const addr_VOC_algorithm_state[] = { 0x61, 0x81 };
+#define VOC_ALGORITHM_STATE_REG_LENGTH 12
+#define GET_VOC_ALGORITHM_STATE_EXECUTION_TIME_ms 20
+#define SET_VOC_ALGORITHM_STATE_EXECUTION_TIME_ms 20
 /****
  * END PRIVATE VARIABLES FOR READ-WRITE FUNCTIONS
  ****/
@@ -99,6 +104,52 @@ uint8_t const addr_activate_SHT_heater[] = { 0x67, 0x65 };
  * END PRIVATE VARIABLES FOR WRITE-ONLY FUNCTIONS
  ****/
 
+/****
+ * BEGIN PRIVATE VARIABLES FOR DUTY-CYCLE FUNCTIONS
+ ****/
+// Approximate time from start of measurement until each channel reads
+// within spec. The gas index and CO2 channels need far longer than PM/RH/T.
+// Override from the build flags if your application tolerates less.
+#ifndef SEN66_PM_STABILIZATION_TIME_ms
+#define SEN66_PM_STABILIZATION_TIME_ms 30000
+#endif
+#ifndef SEN66_RH_T_STABILIZATION_TIME_ms
+#define SEN66_RH_T_STABILIZATION_TIME_ms 10000
+#endif
+#ifndef SEN66_VOC_STABILIZATION_TIME_ms
+#define SEN66_VOC_STABILIZATION_TIME_ms 60000
+#endif
+#ifndef SEN66_CO2_STABILIZATION_TIME_ms
+#define SEN66_CO2_STABILIZATION_TIME_ms 60000
+#endif
+
+#define SAMPLE_INTERVAL_ms 1000
+#define DATA_READY_POLL_INTERVAL_ms 50
+#define DATA_READY_TIMEOUT_ms (2 * SAMPLE_INTERVAL_ms)
+
+// HAL_Delay() waits one tick longer than asked, to guarantee the minimum wait
+#define HAL_DELAY_OVERHEAD_ms 1
+// Worst case bus time of one command, the 27 byte measured values read
+// takes ~2.5 ms at 100 kHz. Lower it from the build flags for fast mode.
+#ifndef SEN66_I2C_TRANSFER_ALLOWANCE_ms
+#define SEN66_I2C_TRANSFER_ALLOWANCE_ms 3
+#endif
+
+// Typical supply figures for the energy estimator, in uA and mV.
+// Override from the build flags with values measured on your board.
+#ifndef SEN66_MEASUREMENT_MODE_CURRENT_uA
+#define SEN66_MEASUREMENT_MODE_CURRENT_uA 70000
+#endif
+#ifndef SEN66_IDLE_MODE_CURRENT_uA
+#define SEN66_IDLE_MODE_CURRENT_uA 2600
+#endif
+#ifndef SEN66_SUPPLY_VOLTAGE_mV
+#define SEN66_SUPPLY_VOLTAGE_mV 3300
+#endif
+/****
+ * END PRIVATE VARIABLES FOR DUTY-CYCLE FUNCTIONS
+ ****/
+
 /****
  * BEGIN INTERNAL FUNCTION PROTOTYPES
  ****/
@@ -118,6 +169,42 @@ static uint8_t SEN66_crc_8_dallas(uint8_t const data[],
 static bool SEN66_crc_ok(uint8_t const data[], size_t const data_length);
 static void SEN66_fill_array_discard_crc(uint8_t dest[],
 		size_t const dest_length, uint8_t const src[], size_t const src_length);
+static void SEN66_fill_array_insert_crc(uint8_t dest[],
+		size_t const dest_length, uint8_t const src[], size_t const src_length);
+
+/**
+ * @brief  Upper bound on the time of one command, as issued by this driver.
+ * @param  execution_time_ms The command execution time from the datasheet
+ * @retval Compensated execution time + HAL_Delay() overhead + I2C transfer
+ */
+static uint32_t SEN66_calculate_command_ms(uint32_t execution_time_ms);
+
+/**
+ * @brief  Upper bound on one data ready poll of SEN66_wait_for_data_ready().
+ * @retval Data ready command + poll interval, in ms
+ */
+static uint32_t SEN66_calculate_data_ready_poll_ms(void);
+
+/**
+ * @brief  Models the time one duty-cycle window keeps the sensor in measurement
+ *         mode, using the same delays the blocking functions of this driver use.
+ *         The last sample is due at most one sample interval per sample after
+ *         the discarded read, and is caught at most one data ready poll late.
+ * @param  p_duty_cycle The duty-cycle schedule
+ * @retval Upper bound on last_window_active_ms, in ms
+ */
+static uint32_t SEN66_calculate_duty_cycle_active_ms(
+		SEN66_duty_cycle_t const *p_duty_cycle);
+
+/**
+ * @brief  How far below the model a measured window may come in. The first
+ *         sample may already be due right after the discarded read, the last
+ *         one may be caught without polling late, the I2C allowance may go
+ *         unused, and HAL_GetTick() is quantized to one tick.
+ * @retval Sample interval + one poll + unused I2C allowance + 1 tick
+ */
+static uint32_t SEN66_calculate_duty_cycle_active_tolerance_ms(void);
+static HAL_StatusTypeDef SEN66_wait_for_data_ready(SEN66_t *p_sen66);
 /****
  * END INTERNAL FUNCTION PROTOTYPES
  ****/
@@ -140,6 +227,9 @@ HAL_StatusTypeDef SEN66_init(SEN66_t *p_sen66, I2C_HandleTypeDef *p_hi2c) {
 	for (int i = 0; i < MEASURED_VALUES_LENGTH; ++i)
 		p_sen66->measured_values[i] = -1; // default all to nonsense values
 
+	for (int i = 0; i < VOC_ALGORITHM_STATE_LENGTH; ++i)
+		p_sen66->VOC_algorithm_state[i] = 0; // only restored once read back
+
 	SEN66_get_serial_number(p_sen66);
 	SEN66_get_product_name(p_sen66);
 	SEN66_read_device_status(p_sen66);
@@ -250,7 +340,7 @@ HAL_StatusTypeDef SEN66_read_device_status(SEN66_t *p_sen66) {
 	if (!SEN66_crc_ok(rx_device_status,
 	DEVICE_STATUS_REG_LENGTH))
 		return HAL_ERROR;
-	SEN66_fill_array_discard_crc(p_sen66->data_ready,
+	SEN66_fill_array_discard_crc(p_sen66->device_status,
 	DEVICE_STATUS_LENGTH, rx_device_status,
 	DEVICE_STATUS_REG_LENGTH);
 	return i2c_status;
@@ -340,7 +430,7 @@ HAL_StatusTypeDef SEN66_read_measured_values(SEN66_t *p_sen66) {
 	if (!SEN66_crc_ok(rx_measured_values,
 	MEASURED_VALUES_REG_LENGTH))
 		return HAL_ERROR;
-	SEN66_fill_array_discard_crc(p_sen66->data_ready,
+	SEN66_fill_array_discard_crc(p_sen66->measured_values,
 	MEASURED_VALUES_LENGTH, rx_measured_values,
 	MEASURED_VALUES_REG_LENGTH);
 	return i2c_status;
@@ -443,11 +533,58 @@ HAL_StatusTypeDef SEN66_read_and_clear_device_status(SEN66_t *p_sen66) {
 	if (!SEN66_crc_ok(rx_device_status,
 	DEVICE_STATUS_REG_LENGTH))
 		return HAL_ERROR;
-	SEN66_fill_array_discard_crc(p_sen66->data_ready,
+	SEN66_fill_array_discard_crc(p_sen66->device_status,
 	DEVICE_STATUS_LENGTH, rx_device_status,
 	DEVICE_STATUS_REG_LENGTH);
 	return i2c_status;
 }
+
+HAL_StatusTypeDef SEN66_get_VOC_algorithm_state(SEN66_t *p_sen66) {
+	uint8_t rx_VOC_algorithm_state[VOC_ALGORITHM_STATE_REG_LENGTH] = { 0x00 };
+	HAL_StatusTypeDef i2c_status = HAL_ERROR;
+
+	i2c_status = HAL_I2C_Master_Transmit(p_sen66->p_hi2c, addr_i2c,
+			(uint8_t*) addr_VOC_algorithm_state,
+			sizeof(addr_VOC_algorithm_state),
+			HAL_MAX_DELAY);
+	if (HAL_OK != i2c_status)
+		return i2c_status;
+	HAL_Delay(SEN66_calculate_clock_tolerance_compensation_ms(
+	GET_VOC_ALGORITHM_STATE_EXECUTION_TIME_ms, 3));
+
+	i2c_status = HAL_I2C_Master_Receive(p_sen66->p_hi2c, addr_i2c,
+			rx_VOC_algorithm_state,
+			VOC_ALGORITHM_STATE_REG_LENGTH,
+			HAL_MAX_DELAY);
+	if (HAL_OK != i2c_status)
+		return i2c_status;
+	if (!SEN66_crc_ok(rx_VOC_algorithm_state,
+	VOC_ALGORITHM_STATE_REG_LENGTH))
+		return HAL_ERROR;
+	SEN66_fill_array_discard_crc(p_sen66->VOC_algorithm_state,
+	VOC_ALGORITHM_STATE_LENGTH, rx_VOC_algorithm_state,
+	VOC_ALGORITHM_STATE_REG_LENGTH);
+	return i2c_status;
+}
+
+HAL_StatusTypeDef SEN66_set_VOC_algorithm_state(SEN66_t const *p_sen66) {
+	uint8_t tx_VOC_algorithm_state[sizeof(addr_VOC_algorithm_state)
+			+ VOC_ALGORITHM_STATE_REG_LENGTH] = { addr_VOC_algorithm_state[0],
+			addr_VOC_algorithm_state[1] };
+	HAL_StatusTypeDef i2c_status = HAL_ERROR;
+
+	SEN66_fill_array_insert_crc(
+			&tx_VOC_algorithm_state[sizeof(addr_VOC_algorithm_state)],
+			VOC_ALGORITHM_STATE_REG_LENGTH, p_sen66->VOC_algorithm_state,
+			VOC_ALGORITHM_STATE_LENGTH);
+	i2c_status = HAL_I2C_Master_Transmit(p_sen66->p_hi2c, addr_i2c,
+			tx_VOC_algorithm_state, sizeof(tx_VOC_algorithm_state),
+			HAL_MAX_DELAY);
+	HAL_Delay(SEN66_calculate_clock_tolerance_compensation_ms(
+	SET_VOC_ALGORITHM_STATE_EXECUTION_TIME_ms, 3));
+
+	return i2c_status;
+}
 /****
  * END READ-WRITE FUNCTIONS
  ****/
@@ -515,6 +652,146 @@ HAL_StatusTypeDef SEN66_activate_SHT_heater(SEN66_t const *p_sen66) {
  * END WRITE-ONLY FUNCTIONS
  ****/
 
+/****
+ * BEGIN DUTY-CYCLE FUNCTIONS
+ ****/
+HAL_StatusTypeDef SEN66_duty_cycle_init(SEN66_duty_cycle_t *p_duty_cycle,
+		uint32_t period_ms, uint8_t samples_per_window, uint8_t channels) {
+	p_duty_cycle->period_ms = period_ms;
+	p_duty_cycle->samples_per_window = samples_per_window;
+	p_duty_cycle->channels = channels & SEN66_CHANNEL_ALL;
+	p_duty_cycle->on_sample = NULL;
+	p_duty_cycle->p_context = NULL;
+	p_duty_cycle->last_window_active_ms = 0;
+	p_duty_cycle->last_window_ms = 0;
+	p_duty_cycle->VOC_algorithm_state_saved = false;
+
+	if (0 == samples_per_window || 0 == p_duty_cycle->channels)
+		return HAL_ERROR;
+	if (channels & SEN66_CHANNEL_NOx)
+		return HAL_ERROR; // NOx index restarts learning on every start
+	if (period_ms < SEN66_calculate_duty_cycle_active_ms(p_duty_cycle))
+		return HAL_ERROR; // the window does not fit in the period
+	return HAL_OK;
+}
+
+uint32_t SEN66_get_duty_cycle_warm_up_ms(
+		SEN66_duty_cycle_t const *p_duty_cycle) {
+	uint32_t warm_up_ms = 0;
+
+	if ((p_duty_cycle->channels & SEN66_CHANNEL_PM)
+			&& warm_up_ms < SEN66_PM_STABILIZATION_TIME_ms)
+		warm_up_ms = SEN66_PM_STABILIZATION_TIME_ms;
+	if ((p_duty_cycle->channels & SEN66_CHANNEL_RH_T)
+			&& warm_up_ms < SEN66_RH_T_STABILIZATION_TIME_ms)
+		warm_up_ms = SEN66_RH_T_STABILIZATION_TIME_ms;
+	if ((p_duty_cycle->channels & SEN66_CHANNEL_VOC)
+			&& warm_up_ms < SEN66_VOC_STABILIZATION_TIME_ms)
+		warm_up_ms = SEN66_VOC_STABILIZATION_TIME_ms;
+	if ((p_duty_cycle->channels & SEN66_CHANNEL_CO2)
+			&& warm_up_ms < SEN66_CO2_STABILIZATION_TIME_ms)
+		warm_up_ms = SEN66_CO2_STABILIZATION_TIME_ms;
+
+	return warm_up_ms;
+}
+
+HAL_StatusTypeDef SEN66_run_duty_cycle_window(SEN66_t *p_sen66,
+		SEN66_duty_cycle_t *p_duty_cycle) {
+	uint32_t const window_start_tick = HAL_GetTick();
+	bool const keep_VOC_algorithm_state = 0
+			!= (p_duty_cycle->channels & SEN66_CHANNEL_VOC);
+	HAL_StatusTypeDef status = HAL_ERROR;
+
+	p_duty_cycle->last_window_active_ms = 0;
+
+	// sensor is idle between windows, the only mode that accepts the state
+	if (keep_VOC_algorithm_state && p_duty_cycle->VOC_algorithm_state_saved) {
+		status = SEN66_set_VOC_algorithm_state(p_sen66);
+		if (HAL_OK != status) {
+			// report it rather than sample a reset algorithm, next window starts fresh
+			p_duty_cycle->VOC_algorithm_state_saved = false;
+			p_duty_cycle->last_window_ms = HAL_GetTick() - window_start_tick;
+			return status;
+		}
+	}
+
+	uint32_t const active_start_tick = HAL_GetTick();
+	status = SEN66_start_continuous_measurement(p_sen66);
+	if (HAL_OK != status) {
+		p_duty_cycle->last_window_active_ms = HAL_GetTick() - active_start_tick;
+		p_duty_cycle->last_window_ms = HAL_GetTick() - window_start_tick;
+		return status;
+	}
+	HAL_Delay(SEN66_get_duty_cycle_warm_up_ms(p_duty_cycle));
+
+	// discard whatever was sampled during warm-up, this also clears data ready
+	status = SEN66_read_measured_values(p_sen66);
+
+	for (uint8_t sample = 0;
+			(HAL_OK == status) && (sample < p_duty_cycle->samples_per_window);
+			++sample) {
+		status = SEN66_wait_for_data_ready(p_sen66);
+		if (HAL_OK != status)
+			break;
+		status = SEN66_read_measured_values(p_sen66);
+		if ((HAL_OK == status) && (NULL != p_duty_cycle->on_sample))
+			p_duty_cycle->on_sample(p_sen66, p_duty_cycle->p_context);
+	}
+
+	// always stop, so a failed window does not leave the fan and laser running
+	HAL_StatusTypeDef const stop_status = SEN66_stop_measurement(p_sen66);
+	p_duty_cycle->last_window_active_ms = HAL_GetTick() - active_start_tick;
+
+	// in idle mode the sensor returns the state as of the stop
+	if (keep_VOC_algorithm_state)
+		p_duty_cycle->VOC_algorithm_state_saved = HAL_OK
+				== SEN66_get_VOC_algorithm_state(p_sen66);
+	p_duty_cycle->last_window_ms = HAL_GetTick() - window_start_tick;
+
+	return HAL_OK != status ? status : stop_status;
+}
+
+uint32_t SEN66_get_duty_cycle_sleep_ms(SEN66_duty_cycle_t const *p_duty_cycle) {
+	if (p_duty_cycle->last_window_ms >= p_duty_cycle->period_ms)
+		return 0;
+	return p_duty_cycle->period_ms - p_duty_cycle->last_window_ms;
+}
+
+void SEN66_estimate_duty_cycle_energy(SEN66_duty_cycle_t const *p_duty_cycle,
+		SEN66_energy_estimate_t *p_estimate) {
+	uint32_t const active_ms = SEN66_calculate_duty_cycle_active_ms(
+			p_duty_cycle);
+	uint32_t const idle_ms =
+			p_duty_cycle->period_ms > active_ms ?
+					p_duty_cycle->period_ms - active_ms : 0;
+
+	// uA * mV * ms = pJ
+	uint64_t const charge_uA_ms = (uint64_t) SEN66_MEASUREMENT_MODE_CURRENT_uA
+			* active_ms + (uint64_t) SEN66_IDLE_MODE_CURRENT_uA * idle_ms;
+	uint64_t const energy_uJ = charge_uA_ms * SEN66_SUPPLY_VOLTAGE_mV
+			/ 1000000;
+	uint64_t const energy_per_sample_uJ =
+			0 != p_duty_cycle->samples_per_window ?
+					energy_uJ / p_duty_cycle->samples_per_window : 0;
+
+	// saturate rather than wrap, periods over ~5.8 days exceed 4295 J
+	p_estimate->active_ms = active_ms;
+	p_estimate->active_tolerance_ms =
+			SEN66_calculate_duty_cycle_active_tolerance_ms();
+	p_estimate->idle_ms = idle_ms;
+	p_estimate->energy_per_period_uJ =
+			energy_uJ > UINT32_MAX ? UINT32_MAX : (uint32_t) energy_uJ;
+	p_estimate->energy_per_sample_uJ =
+			energy_per_sample_uJ > UINT32_MAX ?
+					UINT32_MAX : (uint32_t) energy_per_sample_uJ;
+	p_estimate->average_current_uA =
+			0 != (active_ms + idle_ms) ?
+					(uint32_t) (charge_uA_ms / (active_ms + idle_ms)) : 0;
+}
+/****
+ * END DUTY-CYCLE FUNCTIONS
+ ****/
+
 /****
  * BEGIN INTERNAL HELPER & UTILITY FUNCTIONS
  ****/
@@ -571,6 +848,68 @@ void SEN66_fill_array_discard_crc(uint8_t dest[], size_t const dest_length,
 			++src_iterator; // skip it
 	}
 }
+
+void SEN66_fill_array_insert_crc(uint8_t dest[], size_t const dest_length,
+		uint8_t const src[], size_t const src_length) {
+	for (size_t dest_iterator = 0, src_iterator = 0;
+			(dest_iterator + 2 < dest_length) && (src_iterator + 1 < src_length);
+			dest_iterator += 3, src_iterator += 2) {
+		dest[dest_iterator] = src[src_iterator];
+		dest[dest_iterator + 1] = src[src_iterator + 1];
+		dest[dest_iterator + 2] = SEN66_crc_8_dallas(&src[src_iterator], 2);
+	}
+}
+
+uint32_t SEN66_calculate_command_ms(uint32_t execution_time_ms) {
+	return SEN66_calculate_clock_tolerance_compensation_ms(execution_time_ms, 3)
+			+ HAL_DELAY_OVERHEAD_ms + SEN66_I2C_TRANSFER_ALLOWANCE_ms;
+}
+
+uint32_t SEN66_calculate_data_ready_poll_ms(void) {
+	return SEN66_calculate_command_ms(GET_DATA_READY_EXECUTION_TIME_ms)
+			+ DATA_READY_POLL_INTERVAL_ms + HAL_DELAY_OVERHEAD_ms;
+}
+
+uint32_t SEN66_calculate_duty_cycle_active_ms(
+		SEN66_duty_cycle_t const *p_duty_cycle) {
+	uint32_t const read_ms = SEN66_calculate_command_ms(
+	READ_MEASURED_VALUES_EXECUTION_TIME_ms);
+
+	uint32_t active_ms = SEN66_calculate_command_ms(
+	START_CONTINUOUS_MEASUREMENT_EXECUTION_TIME_ms);
+	active_ms += SEN66_get_duty_cycle_warm_up_ms(p_duty_cycle)
+			+ HAL_DELAY_OVERHEAD_ms;
+	active_ms += read_ms; // warm-up sample, discarded
+	// the sensor paces the samples, earlier reads fit inside the next interval
+	active_ms += p_duty_cycle->samples_per_window * SAMPLE_INTERVAL_ms
+			+ SEN66_calculate_data_ready_poll_ms() + read_ms;
+	active_ms += SEN66_calculate_command_ms(STOP_MEASUREMENT_EXECUTION_TIME_ms);
+	return active_ms; // VOC algorithm state commands run in idle mode
+}
+
+uint32_t SEN66_calculate_duty_cycle_active_tolerance_ms(void) {
+	// start, discarded read, last read, stop
+	uint32_t const commands = 4;
+
+	return SAMPLE_INTERVAL_ms + SEN66_calculate_data_ready_poll_ms()
+			+ commands * SEN66_I2C_TRANSFER_ALLOWANCE_ms + 1;
+}
+
+HAL_StatusTypeDef SEN66_wait_for_data_ready(SEN66_t *p_sen66) {
+	uint32_t const start_tick = HAL_GetTick();
+	HAL_StatusTypeDef i2c_status = HAL_ERROR;
+
+	do {
+		i2c_status = SEN66_get_data_ready(p_sen66);
+		if (HAL_OK != i2c_status)
+			return i2c_status;
+		if (SEN66_is_data_ready(p_sen66))
+			return HAL_OK;
+		HAL_Delay(DATA_READY_POLL_INTERVAL_ms);
+	} while ((HAL_GetTick() - start_tick) < DATA_READY_TIMEOUT_ms);
+
+	return HAL_TIMEOUT;
+}
 /****
  * END INTERNAL HELPER & UTILITY FUNCTIONS
  ****/
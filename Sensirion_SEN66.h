@@ -33,8 +33,59 @@ typedef struct SEN66_t {
 
 #define MEASURED_VALUES_LENGTH 18
 	uint8_t measured_values[MEASURED_VALUES_LENGTH];
+
+#define VOC_ALGORITHM_STATE_LENGTH 8
+	uint8_t VOC_algorithm_state[VOC_ALGORITHM_STATE_LENGTH];
 } SEN66_t;
 
+/**
+ * Channels a duty-cycle window must wait on before sampling. The warm-up time
+ * of a window is the longest stabilization time of the selected channels.
+ *
+ * The VOC algorithm state is saved after each stop and restored before the
+ * next start, both in idle mode, so the VOC index keeps learning across windows. The sensor has
+ * no such command for the NOx index, which restarts its learning phase on
+ * every start. SEN66_duty_cycle_init() therefore rejects SEN66_CHANNEL_NOx,
+ * and the NOx index read in a duty-cycle window is not meaningful.
+ */
+#define SEN66_CHANNEL_PM (1 << 0)
+#define SEN66_CHANNEL_RH_T (1 << 1)
+#define SEN66_CHANNEL_VOC (1 << 2)
+#define SEN66_CHANNEL_NOx (1 << 3)
+#define SEN66_CHANNEL_CO2 (1 << 4)
+// every channel a duty-cycle window accepts, NOx is left out on purpose
+#define SEN66_CHANNEL_ALL (SEN66_CHANNEL_PM | SEN66_CHANNEL_RH_T \
+		| SEN66_CHANNEL_VOC | SEN66_CHANNEL_CO2)
+
+typedef void (*SEN66_sample_callback_t)(SEN66_t const *p_sen66,
+		void *p_context);
+
+typedef struct SEN66_duty_cycle_t {
+	uint32_t period_ms; // start of one window to start of the next
+	uint8_t samples_per_window;
+	uint8_t channels; // SEN66_CHANNEL_* mask
+	SEN66_sample_callback_t on_sample; // called after each sample, may be NULL
+	void *p_context; // handed to on_sample
+
+	uint32_t last_window_active_ms; // start to stop of the last window
+	uint32_t last_window_ms; // whole last window, incl. idle mode VOC commands
+	bool VOC_algorithm_state_saved; // p_sen66->VOC_algorithm_state is restorable
+} SEN66_duty_cycle_t;
+
+/**
+ * active_ms is an upper bound. A window measured on target should satisfy
+ * active_ms - active_tolerance_ms <= last_window_active_ms <= active_ms.
+ * The energy figures use the upper bound, so they err on the high side.
+ */
+typedef struct SEN66_energy_estimate_t {
+	uint32_t active_ms; // sensor in measurement mode, per period, upper bound
+	uint32_t active_tolerance_ms; // how far below active_ms a window may run
+	uint32_t idle_ms; // sensor in idle mode, per period
+	uint32_t energy_per_period_uJ; // saturates at UINT32_MAX
+	uint32_t energy_per_sample_uJ; // saturates at UINT32_MAX
+	uint32_t average_current_uA;
+} SEN66_energy_estimate_t;
+
 HAL_StatusTypeDef SEN66_init(SEN66_t *p_sen66, I2C_HandleTypeDef *p_hi2c);
 
 /****
@@ -73,6 +124,9 @@ uint16_t SEN66_get_CO2_ppm(SEN66_t const *p_sen66); // PPM, 1x scaling
  * BEGIN READ-WRITE FUNCTIONS
  ****/
 HAL_StatusTypeDef SEN66_read_and_clear_device_status(SEN66_t *p_sen66);
+
+HAL_StatusTypeDef SEN66_get_VOC_algorithm_state(SEN66_t *p_sen66);
+HAL_StatusTypeDef SEN66_set_VOC_algorithm_state(SEN66_t const *p_sen66); // idle mode only
 /****
  * END READ-WRITE FUNCTIONS
  ****/
@@ -89,4 +143,20 @@ HAL_StatusTypeDef SEN66_activate_SHT_heater(SEN66_t const *p_sen66);
 /****
  * END WRITE-ONLY FUNCTIONS
  ****/
+
+/****
+ * BEGIN DUTY-CYCLE FUNCTIONS
+ ****/
+HAL_StatusTypeDef SEN66_duty_cycle_init(SEN66_duty_cycle_t *p_duty_cycle,
+		uint32_t period_ms, uint8_t samples_per_window, uint8_t channels);
+uint32_t SEN66_get_duty_cycle_warm_up_ms(
+		SEN66_duty_cycle_t const *p_duty_cycle);
+HAL_StatusTypeDef SEN66_run_duty_cycle_window(SEN66_t *p_sen66,
+		SEN66_duty_cycle_t *p_duty_cycle);
+uint32_t SEN66_get_duty_cycle_sleep_ms(SEN66_duty_cycle_t const *p_duty_cycle);
+void SEN66_estimate_duty_cycle_energy(SEN66_duty_cycle_t const *p_duty_cycle,
+		SEN66_energy_estimate_t *p_estimate);
+/****
+ * END DUTY-CYCLE FUNCTIONS
+ ****/
 #endif /* SENSIRION_SEN66_INC_SENSIRION_SEN66_H_ */